@@ -1,5 +1,7 @@
 #pragma once
 // #include <iostream>
+#include <cstdint>
+#include <type_traits>
 
 namespace ctstr {
 
@@ -53,6 +55,51 @@ struct index_range_impl<First, Step, N, enable_if_t<(N > 1 && N % 2 == 1)>>
                            First + N / 2 * Step, First + (N - 1) * Step>
 {};
 
+// constexpr kernels behind icompare/natural_compare/prefixkey; they agree with
+// the strutil:: runtime versions (bytes compare unsigned).
+constexpr bool isdigit(const char c) { return '0' <= c && c <= '9'; }
+constexpr uint8_t fold(const char c) {
+    return 'A' <= c && c <= 'Z' ? c + ('a' - 'A') : static_cast<uint8_t>(c);
+}
+constexpr uint8_t byte(const char c, const bool icase) {
+    return icase ? fold(c) : static_cast<uint8_t>(c);
+}
+constexpr int cmp(const int a, const int b) { return a < b ? -1 : a > b ? 1 : 0; }
+
+constexpr int icmp(const char* a, const char* b) {
+    return fold(*a) != fold(*b) ? cmp(fold(*a), fold(*b)) :
+           *a == '\0' ? 0 :
+           icmp(a + 1, b + 1);
+}
+
+constexpr const char* skipzeros(const char* s) {
+    return *s == '0' && isdigit(s[1]) ? skipzeros(s + 1) : s;
+}
+constexpr int digits(const char* s) { return isdigit(*s) ? 1 + digits(s + 1) : 0; }
+constexpr int digitcmp(const char* a, const char* b, const int n) {
+    return n == 0 ? 0 : *a != *b ? cmp(*a, *b) : digitcmp(a + 1, b + 1, n - 1);
+}
+
+constexpr int natcmp(const char* a, const char* b, const bool icase);
+constexpr int numcmp(const char* a, const char* b, const int la, const int lb, const bool icase) {
+    return la != lb ? cmp(la, lb) :
+           digitcmp(a, b, la) != 0 ? digitcmp(a, b, la) :
+           natcmp(a + la, b + lb, icase);
+}
+constexpr int natcmp(const char* a, const char* b, const bool icase) {
+    return isdigit(*a) && isdigit(*b) ?
+               numcmp(skipzeros(a), skipzeros(b), digits(skipzeros(a)), digits(skipzeros(b)), icase) :
+           byte(*a, icase) != byte(*b, icase) ? cmp(byte(*a, icase), byte(*b, icase)) :
+           *a == '\0' ? 0 :
+           natcmp(a + 1, b + 1, icase);
+}
+
+constexpr uint64_t packkey(const char* s, const int n, const bool icase) {
+    return n == 0 ? 0 :
+           static_cast<uint64_t>(byte(*s, icase)) << (8 * (n - 1)) |
+           packkey(*s ? s + 1 : s, n - 1, icase);
+}
+
 }   // namespace _detail
 
 template<int First, int Last, int Step = 1>
@@ -183,6 +230,20 @@ struct ctstr {
         return for_each(comparator<M>(ctstr<M>(v))).result;
     }
     template<int M>
+    constexpr int icompare(const ctstr<M>& s) const { return _detail::icmp(data, s.data); }
+    template<int M>
+    constexpr int icompare(const char (&v)[M]) const { return _detail::icmp(data, v); }
+    template<int M>
+    constexpr int natural_compare(const ctstr<M>& s, bool ignorecase=false) const {
+        return _detail::natcmp(data, s.data, ignorecase);
+    }
+    template<int M>
+    constexpr int natural_compare(const char (&v)[M], bool ignorecase=false) const {
+        return _detail::natcmp(data, v, ignorecase);
+    }
+    constexpr uint64_t prefixkey() const { return _detail::packkey(data, 8, false); }
+    constexpr uint64_t iprefixkey() const { return _detail::packkey(data, 8, true); }
+    template<int M>
     constexpr bool equals(const ctstr<M>& s) const { return compare(s) == 0; }
     template<int M>
     constexpr bool equals(const char (&v)[M]) const { return compare(v) == 0; }
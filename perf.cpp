@@ -0,0 +1,274 @@
+// performance regression guard.
+//
+//   ./perf_bench <baseline> [threshold%]   compare against baseline, fail past threshold
+//   ./perf_bench --update <baseline>       rewrite baseline with current counts
+//
+// workloads are measured in retired user-space instructions rather than time,
+// so results stay comparable on a noisy machine. each workload runs in a
+// forked child that the parent single-steps with ptrace, which counts exactly
+// (like valgrind) and needs neither a hardware counter nor extra tools. the
+// price is speed, so workloads are kept small.
+//
+// glibc picks memcpy/memchr/strlen variants by cpu feature, which moves the
+// counts by several percent between machines. the bench therefore re-execs
+// itself with those features masked down to baseline x86-64 (see tunables)
+// and with address randomization off. what remains is the compiler, flags and
+// glibc version used by `make perf`; the baseline records the latter two.
+#include <sys/personality.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <alloca.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <gnu/libc-version.h>
+#include "strutil.h"
+
+
+struct countererror : public std::runtime_error {
+    countererror(const std::string& s) :std::runtime_error(s) {}
+};
+
+__attribute__((noinline))
+void scrubstack() {
+    volatile char junk[1 << 16];
+    for (size_t i = 0; i < sizeof(junk); ++i) junk[i] = 0;
+}
+
+// instructions executed by f, measured between two SIGSTOP markers raised by
+// the traced child. f runs once beforehand so lazy binding and allocator
+// warm-up are not counted.
+uint64_t measure(const std::function<void()>& f) {
+    pid_t pid = fork();
+    if (pid < 0) throw countererror("fork failed");
+    if (pid == 0) {
+        if (ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) < 0) _exit(1);
+        // glibc's sse2 string functions read whole 16-byte blocks, so bytes
+        // past the end of short stack strings take part in branches. they are
+        // leftovers from earlier frames, including the per-process random
+        // stack canary; fix the canary (this frame never returns) and clear
+        // the stack so they are the same on every run.
+#if defined(__x86_64__)
+        __asm__ volatile("movq $0, %%fs:0x28" ::: "memory");
+#endif
+        scrubstack();
+        f();
+        raise(SIGSTOP);
+        f();
+        raise(SIGSTOP);
+        _exit(0);
+    }
+    int status;
+    if (waitpid(pid, &status, 0) < 0 || !WIFSTOPPED(status) || WSTOPSIG(status) != SIGSTOP) {
+        kill(pid, SIGKILL);
+        waitpid(pid, &status, 0);
+        throw countererror("could not trace workload (ptrace disabled?)");
+    }
+    uint64_t n = 0;
+    for (;;) {
+        if (ptrace(PTRACE_SINGLESTEP, pid, nullptr, nullptr) < 0 || waitpid(pid, &status, 0) < 0) {
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            throw countererror("single-step failed");
+        }
+        if (!WIFSTOPPED(status)) throw countererror("workload exited before its end marker");
+        if (WSTOPSIG(status) != SIGTRAP) break;
+        n++;
+    }
+    int sig = WSTOPSIG(status);
+    kill(pid, SIGKILL);
+    waitpid(pid, &status, 0);
+    if (sig != SIGSTOP) throw countererror("workload stopped by unexpected signal");
+    if (n == 0) throw countererror("counted no instructions");
+    return n;
+}
+
+
+// deterministic inputs, identical on every machine.
+struct lcg {
+    uint32_t x = 12345;
+    uint32_t operator()(uint32_t n) { x = x * 1103515245 + 12345; return (x >> 16) % n; }
+};
+
+std::string word(lcg& r, size_t len) {
+    std::string s;
+    for (size_t i = 0; i < len; ++i) s.push_back("abcdefghijKLMNOPQRST0123456789"[r(30)]);
+    return s;
+}
+
+volatile size_t sink = 0;
+
+#ifdef __clang__
+const std::string compiler = "clang " __VERSION__;
+#else
+const std::string compiler = "gcc " __VERSION__;
+#endif
+
+const std::string libc = std::string("glibc ") + gnu_get_libc_version();
+
+// cpu features above sse2 that steer glibc's string function selection, plus
+// fixed cache sizes and thresholds instead of the detected ones.
+const char* tunables =
+    "glibc.cpu.hwcaps=-AVX,-AVX2,-AVX512F,-AVX512VL,-AVX512BW,-AVX512DQ,-AVX512CD,-AVX_VNNI,"
+    "-SSE3,-SSSE3,-SSE4_1,-SSE4_2,-BMI1,-BMI2,-LZCNT,-MOVBE,-POPCNT,-RTM,-ERMS,-FSRM,"
+    "-FMA,-FMA4,-XSAVE,-XSAVEC,-F16C,-OSXSAVE,-Fast_Rep_String,-Fast_Unaligned_Load,"
+    "-Fast_Unaligned_Copy,-Fast_Copy_Backward,-Slow_BSF,-Prefer_PMINUB_for_stringop,"
+    "-Slow_SSE4_2,-Prefer_No_VZEROUPPER,-Prefer_ERMS,-Prefer_FSRM,-Prefer_No_AVX512,"
+    "-AVX_Fast_Unaligned_Load"
+    ":glibc.cpu.x86_data_cache_size=0x8000:glibc.cpu.x86_shared_cache_size=0x100000"
+    ":glibc.cpu.x86_non_temporal_threshold=0xc0000"
+    ":glibc.cpu.x86_rep_movsb_threshold=0x800:glibc.cpu.x86_rep_stosb_threshold=0x800";
+
+// re-execs once with the pinned environment; false if it could not be set up.
+bool pinenvironment(char** argv) {
+    int persona = personality(0xffffffff);
+    if (persona == -1) return false;
+    const char* env = getenv("GLIBC_TUNABLES");
+    if ((persona & ADDR_NO_RANDOMIZE) && env && std::string(env) == tunables) return true;
+    if (getenv("PERF_BENCH_PINNED")) return false;  // already tried.
+    if (personality(persona | ADDR_NO_RANDOMIZE) == -1 ||
+        setenv("GLIBC_TUNABLES", tunables, 1) != 0 || setenv("PERF_BENCH_PINNED", "1", 1) != 0)
+        return false;
+    execv("/proc/self/exe", argv);
+    return false;
+}
+
+
+// everything that allocates before the workloads are forked is independent of
+// the arguments and the baseline file, so the child's heap is the same on
+// every run.
+__attribute__((noinline))
+int bench(bool update, const char* path, double threshold)
+{
+    using namespace strutil;
+
+    lcg r;
+    std::vector<std::string> levels = {"INFO", "WARN", "ERROR", "DEBUG"};
+    std::vector<std::string> words, padded, tsv, mixed, payloads;
+    for (int i = 0; i < 100; ++i) {
+        words.push_back(word(r, 4 + r(16)));
+        padded.push_back(std::string(r(8), ' ') + words.back() + std::string(r(8), '\t') + "\r\n");
+        std::string line;
+        for (int k = 0; k < 12; ++k) line += (k ? "\t" : "") + word(r, r(12));
+        tsv.push_back(line);
+        mixed.push_back(word(r, 64));
+        payloads.push_back(word(r, 40) + (r(4) ? "" : "\"quoted\"\n") + word(r, 40));
+    }
+
+    std::map<std::string, std::function<void()>> workloads;
+    workloads["format_logline"] = [&] {
+        for (size_t i = 0; i < words.size(); ++i) {
+            sink += format("%s [%-5s] %08x %-20s %d", "2026-10-19T00:00:00", levels[i % 4],
+                           static_cast<unsigned>(i), words[i], static_cast<int>(i * 37)).size();
+        }
+    };
+    workloads["split_tsv"] = [&] {
+        for (const auto& line: tsv) sink += split(line, '\t').size();
+    };
+    workloads["trim_whitespace"] = [&] {
+        for (const auto& s: padded) sink += trim(s).size();
+    };
+    workloads["casefold"] = [&] {
+        for (const auto& s: mixed) sink += lower(s).size() + upper(s).size();
+    };
+    workloads["jsonescape"] = [&] {
+        for (const auto& s: payloads) sink += jsonescape(s).size();
+    };
+
+    std::map<std::string, uint64_t> current;
+    try {
+        for (const auto& w: workloads) current[w.first] = measure(w.second);
+    } catch (const countererror& e) {
+        std::cerr << "perf: " << e.what() << std::endl;
+        return 2;
+    }
+
+    std::map<std::string, uint64_t> baseline;
+    if (!update) {
+        std::ifstream in(path);
+        if (!in) {
+            std::cerr << "perf: cannot read " << path << std::endl;
+            return 2;
+        }
+        for (std::string line; std::getline(in, line);) {
+            if (line.compare(0, 12, "# compiler: ") == 0 && line.substr(12) != compiler)
+                std::cerr << "perf: warning: baseline was recorded with " << line.substr(12) << std::endl;
+            if (line.compare(0, 8, "# libc: ") == 0 && line.substr(8) != libc)
+                std::cerr << "perf: warning: baseline was recorded with " << line.substr(8) << std::endl;
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream ss(line);
+            std::string name;
+            uint64_t n = 0;
+            if (!(ss >> name >> n) || n == 0) {
+                std::cerr << "perf: invalid baseline entry: " << line << std::endl;
+                return 2;
+            }
+            baseline[name] = n;
+        }
+    }
+
+    if (update) {
+        std::ofstream out(path);
+        out << "# instructions per workload; regenerate with `make perf-baseline`." << std::endl;
+        out << "# compiler: " << compiler << std::endl;
+        out << "# libc: " << libc << std::endl;
+        for (const auto& e: current) out << e.first << " " << e.second << std::endl;
+        if (!out) {
+            std::cerr << "perf: cannot write " << path << std::endl;
+            return 2;
+        }
+        std::cout << "perf: wrote " << path << std::endl;
+        return 0;
+    }
+
+    int failed = 0;
+    printf("%-20s %14s %14s %8s\n", "workload", "baseline", "current", "delta");
+    for (const auto& e: current) {
+        auto it = baseline.find(e.first);
+        if (it == baseline.end()) {
+            printf("%-20s %14s %14llu  MISSING\n", e.first.c_str(), "-", (unsigned long long)e.second);
+            failed++;
+            continue;
+        }
+        double delta = (static_cast<double>(e.second) / it->second - 1.0) * 100.0;
+        bool bad = delta > threshold;
+        failed += bad;
+        printf("%-20s %14llu %14llu %+7.2f%%%s\n", e.first.c_str(), (unsigned long long)it->second,
+               (unsigned long long)e.second, delta, bad ? "  REGRESSION" : "");
+    }
+    if (failed) {
+        printf("perf: %d workload(s) regressed by more than %.2f%% or have no baseline\n",
+               failed, threshold);
+        return 1;
+    }
+    return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    // string kernels take different paths depending on alignment and cpu,
+    // so counts are only repeatable in the pinned environment.
+    if (!pinenvironment(argv)) {
+        std::cerr << "perf: cannot disable address randomization or pin glibc tunables" << std::endl;
+        return 2;
+    }
+
+    bool update = argc > 1 && std::strcmp(argv[1], "--update") == 0;
+    if (argc < (update ? 3 : 2)) {
+        std::cerr << "usage: perf_bench <baseline> [threshold%] | perf_bench --update <baseline>" << std::endl;
+        return 2;
+    }
+    double threshold = !update && argc > 2 ? std::atof(argv[2]) : 3.0;
+
+    // argv and the environment sit above the stack and shift it by their size;
+    // start the bench at a fixed offset within a page.
+    volatile char* pad = static_cast<char*>(alloca((reinterpret_cast<uintptr_t>(&argc) & 0xFFF) + 64));
+    pad[0] = 0;
+    return bench(update, argv[update ? 2 : 1], threshold);
+}
@@ -1,7 +1,20 @@
 #include <string>
 #include <vector>
+#include <tuple>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
 #include <sstream>  // TODO: remove.
 
+#if !defined(STRUTIL_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define STRUTIL_SSE2 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
 namespace strutil {
 
 template<bool cond, class T = void>
@@ -18,6 +31,116 @@ public:
 };
 
 
+namespace _detail {
+
+#ifdef STRUTIL_SSE2
+inline __m128i splat(char c) { return _mm_set1_epi8(c); }
+
+// unsigned v <= c
+inline __m128i le(__m128i v, char c) { return _mm_cmpeq_epi8(_mm_max_epu8(v, splat(c)), splat(c)); }
+
+// unsigned lo <= v <= hi
+inline __m128i inrange(__m128i v, char lo, char hi) {
+    return _mm_cmpeq_epi8(_mm_min_epu8(_mm_max_epu8(v, splat(lo)), splat(hi)), v);
+}
+
+inline __m128i eq(__m128i v, char c) { return _mm_cmpeq_epi8(v, splat(c)); }
+
+// index of the lowest set bit; m must be non-zero.
+inline int ctz(uint32_t m) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, m);
+    return static_cast<int>(i);
+#else
+    return __builtin_ctz(m);
+#endif
+}
+#endif
+
+// returns the offset of the first byte at or after i that Class matches, or n. clean runs are skipped 16 bytes at a time.
+template<class Class>
+inline size_t scan(const char* s, size_t n, size_t i=0) {
+#ifdef STRUTIL_SSE2
+    for (; i + 16 <= n; i += 16) {
+        int m = Class::mask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i)));
+        if (m) return i + ctz(m);
+    }
+#endif
+    for (; i < n; ++i) {
+        if (Class::test(static_cast<uint8_t>(s[i]))) return i;
+    }
+    return n;
+}
+
+struct nonascii {
+    static bool test(uint8_t c) { return c >= 0x80; }
+#ifdef STRUTIL_SSE2
+    static int mask(__m128i v) { return _mm_movemask_epi8(v); }
+#endif
+};
+
+// decodes the utf-8 sequence at s[i] and advances i past it.
+// malformed or truncated sequences consume one byte and yield U+FFFD.
+inline uint32_t u8decode(const char* s, size_t n, size_t& i) {
+    const uint8_t* u = reinterpret_cast<const uint8_t*>(s);
+    uint8_t c = u[i];
+    size_t len = c < 0x80 ? 1 : (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 0;
+    if (len == 0 || i + len > n) {
+        i++;
+        return len == 1 ? c : 0xFFFD;
+    }
+    uint32_t uc = len == 1 ? c : c & (0x7F >> len);
+    for (size_t k = 1; k < len; ++k) {
+        if ((u[i + k] & 0xC0) != 0x80) {
+            i++;
+            return 0xFFFD;
+        }
+        uc = uc << 6 | (u[i + k] & 0x3F);
+    }
+    i += len;
+    return uc;
+}
+
+// terminal columns of a code point: 0 for combining marks, 2 for east asian
+// wide/fullwidth (UAX #11 W and F), 1 otherwise. an approximation of wcwidth().
+inline int ucwidth(uint32_t uc) {
+    static const uint32_t zero[][2] = {
+        {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x0610, 0x061A},
+        {0x064B, 0x065F}, {0x0E31, 0x0E31}, {0x0E34, 0x0E3A}, {0x0E47, 0x0E4E},
+        {0x1AB0, 0x1AFF}, {0x1DC0, 0x1DFF}, {0x200B, 0x200F}, {0x2028, 0x202E},
+        {0x2060, 0x2064}, {0x20D0, 0x20FF}, {0x3099, 0x309A}, {0xFE00, 0xFE0F},
+        {0xFE20, 0xFE2F}, {0xFEFF, 0xFEFF}, {0xE0001, 0xE007F}, {0xE0100, 0xE01EF},
+    };
+    static const uint32_t wide[][2] = {
+        {0x1100, 0x115F}, {0x231A, 0x231B}, {0x2329, 0x232A}, {0x23E9, 0x23EC},
+        {0x2614, 0x2615}, {0x2648, 0x2653}, {0x26AA, 0x26AB}, {0x26BD, 0x26BE},
+        {0x26C4, 0x26C5}, {0x2705, 0x2705}, {0x2728, 0x2728}, {0x274C, 0x274C},
+        {0x2753, 0x2755}, {0x2795, 0x2797}, {0x2B1B, 0x2B1C}, {0x2E80, 0x303E},
+        {0x3041, 0x33FF}, {0x3400, 0x4DBF}, {0x4E00, 0x9FFF}, {0xA000, 0xA4CF},
+        {0xA960, 0xA97F}, {0xAC00, 0xD7A3}, {0xF900, 0xFAFF}, {0xFE10, 0xFE19},
+        {0xFE30, 0xFE6F}, {0xFF00, 0xFF60}, {0xFFE0, 0xFFE6}, {0x16FE0, 0x18AFF},
+        {0x1B000, 0x1B2FF}, {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF}, {0x1F18E, 0x1F18E},
+        {0x1F191, 0x1F19A}, {0x1F200, 0x1F251}, {0x1F300, 0x1F64F}, {0x1F680, 0x1F6FF},
+        {0x1F7E0, 0x1F7EB}, {0x1F900, 0x1F9FF}, {0x1FA70, 0x1FAFF}, {0x20000, 0x2FFFD},
+        {0x30000, 0x3FFFD},
+    };
+    if (uc < 0x300) return 1;
+    for (const auto& r: zero) {
+        if (uc < r[0]) break;
+        if (uc <= r[1]) return 0;
+    }
+    if (uc < 0x1100) return 1;
+    for (const auto& r: wide) {
+        if (uc < r[0]) break;
+        if (uc <= r[1]) return 2;
+    }
+    return 1;
+}
+
+}  // namespace _detail
+
+
 inline
 std::string lower(const std::string& s) {
     std::string r(0, ' ');
@@ -64,16 +187,111 @@ std::string trim(std::string s, const std::string& chars=" \t\r\n") {
     return ltrim(rtrim(s, chars));
 }
 
+// how padding and truncation measure a string.
+enum class widthmode {
+    bytes,       // std::string::size()
+    codepoints,  // utf-8 code points
+    columns,     // terminal columns (east asian wide = 2, combining = 0)
+};
+
+namespace _detail {
+
+inline size_t unitwidth(uint32_t uc, widthmode mode) {
+    return mode == widthmode::columns ? ucwidth(uc) : 1;
+}
+
+// byte length of the longest prefix of s that fits in width; its width goes to w.
+inline size_t fit(const std::string& s, size_t width, widthmode mode, size_t& w) {
+    if (mode == widthmode::bytes) {
+        w = std::min(s.size(), width);
+        return w;
+    }
+    size_t i = 0;
+    w = 0;
+    while (i < s.size()) {
+        size_t j = std::min(scan<nonascii>(s.data(), s.size(), i), i + (width - w));
+        w += j - i;
+        i = j;
+        if (w == width || i == s.size()) break;
+        size_t next = i;
+        size_t uw = unitwidth(u8decode(s.data(), s.size(), next), mode);
+        if (w + uw > width) break;
+        w += uw;
+        i = next;
+    }
+    // keep trailing zero-width marks with their base character.
+    while (i < s.size() && mode == widthmode::columns) {
+        size_t next = i;
+        if (ucwidth(u8decode(s.data(), s.size(), next)) != 0) break;
+        i = next;
+    }
+    return i;
+}
+
+inline std::string padded(const std::string& s, size_t left, size_t right, char c) {
+    std::string r;
+    r.reserve(left + s.size() + right);
+    r.append(left, c).append(s).append(right, c);
+    return r;
+}
+
+}  // namespace _detail
+
+inline
+size_t strwidth(const std::string& s, widthmode mode=widthmode::bytes) {
+    if (mode == widthmode::bytes) return s.size();
+    size_t w = 0;
+    size_t i = 0;
+    while (i < s.size()) {
+        size_t j = _detail::scan<_detail::nonascii>(s.data(), s.size(), i);
+        w += j - i;
+        i = j;
+        if (i == s.size()) break;
+        w += _detail::unitwidth(_detail::u8decode(s.data(), s.size(), i), mode);
+    }
+    return w;
+}
+
 inline
-std::string padright(std::string s, size_t width, const char c=' ') {
-    if (s.size() >= width) return s;
-    return s + std::string(width - s.size(), c);
+std::string padright(const std::string& s, size_t width, const char c=' ',
+                     widthmode mode=widthmode::bytes) {
+    size_t w = strwidth(s, mode);
+    if (w >= width) return s;
+    return _detail::padded(s, 0, width - w, c);
 }
 
 inline
-std::string padleft(const std::string& s, size_t width, const char c=' ') {
-    if (s.size() >= width) return s;
-    return std::string(width - s.size(), c) + s;
+std::string padleft(const std::string& s, size_t width, const char c=' ',
+                    widthmode mode=widthmode::bytes) {
+    size_t w = strwidth(s, mode);
+    if (w >= width) return s;
+    return _detail::padded(s, width - w, 0, c);
+}
+
+inline
+std::string center(const std::string& s, size_t width, const char c=' ',
+                   widthmode mode=widthmode::bytes) {
+    size_t w = strwidth(s, mode);
+    if (w >= width) return s;
+    return _detail::padded(s, (width - w) / 2, width - w - (width - w) / 2, c);
+}
+
+// cuts s down to at most width, never splitting a code point (or a double
+// column character) in the non-byte modes. ellipsis is appended when
+// anything was cut and counts towards width.
+inline
+std::string truncate(const std::string& s, size_t width, widthmode mode=widthmode::bytes,
+                     const std::string& ellipsis="") {
+    size_t w;
+    size_t len = _detail::fit(s, width, mode, w);
+    if (len == s.size()) return s;
+    size_t ew = strwidth(ellipsis, mode);
+    if (ew > width) return s.substr(0, len);
+    len = _detail::fit(s, width - ew, mode, w);
+    std::string r;
+    r.reserve(len + ellipsis.size());
+    r.append(s, 0, len).append(ellipsis);
+    return r;
 }
 
 inline
@@ -117,6 +335,120 @@ std::vector<std::string> split(const std::string& s, const char delim)
 
 namespace _detail {
 
+inline bool isdigit(const char c) { return '0' <= c && c <= '9'; }
+
+inline uint8_t fold(uint8_t c) {
+    return ('A' <= c && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+// first index below n where a and b differ (ascii case-folded if Fold), or n.
+template<bool Fold>
+inline size_t mismatch(const char* a, const char* b, size_t n) {
+    size_t i = 0;
+#ifdef STRUTIL_SSE2
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        if (Fold) {
+            x = _mm_add_epi8(x, _mm_and_si128(inrange(x, 'A', 'Z'), splat(0x20)));
+            y = _mm_add_epi8(y, _mm_and_si128(inrange(y, 'A', 'Z'), splat(0x20)));
+        }
+        int m = ~_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xFFFF;
+        if (m) return i + ctz(m);
+    }
+#endif
+    for (; i < n; ++i) {
+        uint8_t x = a[i], y = b[i];
+        if (Fold ? fold(x) != fold(y) : x != y) return i;
+    }
+    return n;
+}
+
+inline int sign(long long v) { return v < 0 ? -1 : v > 0 ? 1 : 0; }
+
+}  // namespace _detail
+
+// ascii case-insensitive three-way comparison (-1, 0, 1) without allocating.
+// bytes compare unsigned, so this orders like strcmp(lower(a), lower(b)).
+inline
+int icompare(const char* a, size_t an, const char* b, size_t bn) {
+    size_t i = _detail::mismatch<true>(a, b, std::min(an, bn));
+    if (i < an && i < bn) return _detail::fold(a[i]) < _detail::fold(b[i]) ? -1 : 1;
+    return _detail::sign(static_cast<long long>(an) - static_cast<long long>(bn));
+}
+
+inline
+int icompare(const std::string& a, const std::string& b) {
+    return icompare(a.data(), a.size(), b.data(), b.size());
+}
+
+// compares runs of digits by numeric value, so "0.1.10" > "0.1.9" and
+// "file2" < "file10". leading zeros are ignored ("01" == "1").
+inline
+int natural_compare(const char* a, size_t an, const char* b, size_t bn, bool ignorecase=false) {
+    size_t n = std::min(an, bn);
+    size_t i = ignorecase ? _detail::mismatch<true>(a, b, n) : _detail::mismatch<false>(a, b, n);
+    // the shared prefix may end inside a number; restart at its first digit.
+    while (i > 0 && _detail::isdigit(a[i - 1])) i--;
+    size_t j = i;
+    while (i < an && j < bn) {
+        if (_detail::isdigit(a[i]) && _detail::isdigit(b[j])) {
+            while (a[i] == '0' && i + 1 < an && _detail::isdigit(a[i + 1])) i++;
+            while (b[j] == '0' && j + 1 < bn && _detail::isdigit(b[j + 1])) j++;
+            size_t si = i, sj = j;
+            while (i < an && _detail::isdigit(a[i])) i++;
+            while (j < bn && _detail::isdigit(b[j])) j++;
+            if (i - si != j - sj) return i - si < j - sj ? -1 : 1;
+            int c = std::memcmp(a + si, b + sj, i - si);
+            if (c != 0) return _detail::sign(c);
+            continue;
+        }
+        uint8_t x = a[i], y = b[j];
+        if (ignorecase) {
+            x = _detail::fold(x);
+            y = _detail::fold(y);
+        }
+        if (x != y) return x < y ? -1 : 1;
+        i++;
+        j++;
+    }
+    return (i == an) == (j == bn) ? 0 : i == an ? -1 : 1;
+}
+
+inline
+int natural_compare(const std::string& a, const std::string& b, bool ignorecase=false) {
+    return natural_compare(a.data(), a.size(), b.data(), b.size(), ignorecase);
+}
+
+// packs the first 8 bytes big-endian (zero-filled), so comparing keys as
+// integers orders like comparing the strings. equal keys still need a full
+// compare. iprefixkey folds case first and is consistent with icompare.
+inline
+uint64_t prefixkey(const char* s, size_t n) {
+    uint64_t k = 0;
+    for (size_t i = 0; i < 8; ++i) k = k << 8 | (i < n ? static_cast<uint8_t>(s[i]) : 0);
+    return k;
+}
+
+inline
+uint64_t prefixkey(const std::string& s) {
+    return prefixkey(s.data(), s.size());
+}
+
+inline
+uint64_t iprefixkey(const char* s, size_t n) {
+    uint64_t k = 0;
+    for (size_t i = 0; i < 8; ++i) k = k << 8 | (i < n ? _detail::fold(s[i]) : 0);
+    return k;
+}
+
+inline
+uint64_t iprefixkey(const std::string& s) {
+    return iprefixkey(s.data(), s.size());
+}
+
+namespace _detail {
+
 inline
 std::string u8char(uint32_t uc) {
     if ((uc & ~0x007F) == 0) {
@@ -239,8 +571,6 @@ std::string floatformatter(double d, int precision=6,
     return ss.str();
 }
 
-inline bool isdigit(const char c) { return '0' <= c && c <= '9'; }
-
 template<size_t I = 0, class F, class...T, enable_when<I == sizeof...(T)> = nullptr>
 std::string call_for_index(int, std::tuple<T...>&, F) {
     return "";
@@ -266,6 +596,7 @@ struct formatter_ {
     bool alignleft = false;
     int width = 0;
     int precision = 6;
+    widthmode mode = widthmode::bytes;  // 'l': code points, 'L': columns
 
     inline
     formatter_(const std::string& s, size_t start=0) {
@@ -283,15 +614,20 @@ struct formatter_ {
             }
             break;
         }
-        if (_detail::isdigit(s[i])) { width = s[i] - '0'; i++; }
-        if (_detail::isdigit(s[i])) { width = width * 10 + s[i] - '0'; i++; }
+        for (; _detail::isdigit(s[i]); ++i) {
+            width = width * 10 + s[i] - '0';
+            if (width > 0xFFFFFF)
+                throw formaterror("invalid format (width too large)");
+        }
         if (s[i] == '.') {
             i++;
             if (_detail::isdigit(s[i])) { precision = s[i] - '0'; i++; }
             if (_detail::isdigit(s[i])) { precision = precision * 10 + s[i] - '0'; i++; }
         }
         if (_detail::isdigit(s[i]))
-            throw formaterror("invalid format (width or precision too long)");
+            throw formaterror("invalid format (precision too long)");
+        if (s[i] == 'l') { mode = widthmode::codepoints; i++; }
+        else if (s[i] == 'L') { mode = widthmode::columns; i++; }
         conv = s[i++];
         str = s.substr(start, i - start);
     }
@@ -369,12 +705,10 @@ struct formatter_ {
     inline
     std::string pad(const std::string& s, int w=-1) {
         if (w == -1) w = width;
-        if (s.size() > 99) return s;
-        if (w <= (int)s.size()) return s;
         if (alignleft) {
-            return padright(s, w, ' ');
+            return padright(s, w, ' ', mode);
         } else {
-            return padleft(s, w, padchar);
+            return padleft(s, w, padchar, mode);
         }
     }
 
@@ -414,4 +748,505 @@ std::string format(const std::string& fmt, A...a) {
 }
 
 
+// ----------------------------------------------------------------------------
+// codecs
+//
+// every codec comes in three flavours:
+//   xxxsize(s, n)     exact output size (decoders may throw decodeerror)
+//   xxx(out, s, n)    writes into caller buffer, returns bytes written
+//   xxx(str)          returns a std::string allocated once
+// unescapers never grow their input, so a buffer of n bytes is always enough
+// and decoding in place (out == s) is allowed.
+
+struct decodeerror : public fail {
+    decodeerror(const char* s) :fail(s) {}
+};
+
+namespace _detail {
+
+template<class Class>
+inline size_t escapesize(const char* s, size_t n) {
+    size_t size = n;
+    for (size_t i = scan<Class>(s, n); i < n; i = scan<Class>(s, n, i + 1)) {
+        size += Class::width(static_cast<uint8_t>(s[i])) - 1;
+    }
+    return size;
+}
+
+template<class Class>
+inline size_t escape(char* out, const char* s, size_t n) {
+    char* o = out;
+    size_t i = 0;
+    while (i < n) {
+        size_t j = scan<Class>(s, n, i);
+        std::memcpy(o, s + i, j - i);
+        o += j - i;
+        if (j == n) break;
+        o += Class::put(o, static_cast<uint8_t>(s[j]));
+        i = j + 1;
+    }
+    return o - out;
+}
+
+template<size_t (*Size)(const char*, size_t), size_t (*Write)(char*, const char*, size_t)>
+inline std::string sized(const std::string& s) {
+    std::string r(Size(s.data(), s.size()), '\0');
+    Write(&r[0], s.data(), s.size());
+    return r;
+}
+
+template<size_t (*Write)(char*, const char*, size_t)>
+inline std::string bounded(const std::string& s) {
+    std::string r(s.size(), '\0');
+    r.resize(Write(&r[0], s.data(), s.size()));
+    return r;
+}
+
+inline int hexval(char c) {
+    return ('0' <= c && c <= '9') ? c - '0' :
+           ('a' <= c && c <= 'f') ? c - 'a' + 10 :
+           ('A' <= c && c <= 'F') ? c - 'A' + 10 : -1;
+}
+
+inline int hexbyte(const char* s) {
+    int h = hexval(s[0]), l = hexval(s[1]);
+    return (h < 0 || l < 0) ? -1 : h << 4 | l;
+}
+
+// writes uc as utf-8, returns length.
+inline size_t u8put(char* o, uint32_t uc) {
+    if (uc < 0x80) {
+        o[0] = static_cast<char>(uc);
+        return 1;
+    } else if (uc < 0x800) {
+        o[0] = static_cast<char>(0xC0 | (uc >> 6));
+        o[1] = static_cast<char>(0x80 | (uc & 0x3F));
+        return 2;
+    } else if (uc < 0x10000) {
+        o[0] = static_cast<char>(0xE0 | (uc >> 12));
+        o[1] = static_cast<char>(0x80 | ((uc >> 6) & 0x3F));
+        o[2] = static_cast<char>(0x80 | (uc & 0x3F));
+        return 3;
+    } else if (uc < 0x110000) {
+        o[0] = static_cast<char>(0xF0 | (uc >> 18));
+        o[1] = static_cast<char>(0x80 | ((uc >> 12) & 0x3F));
+        o[2] = static_cast<char>(0x80 | ((uc >> 6) & 0x3F));
+        o[3] = static_cast<char>(0x80 | (uc & 0x3F));
+        return 4;
+    }
+    throw fail("unknown unicode");
+}
+
+struct jsonclass {
+    static bool test(uint8_t c) { return c < 0x20 || c == '"' || c == '\\'; }
+#ifdef STRUTIL_SSE2
+    static int mask(__m128i v) {
+        return _mm_movemask_epi8(_mm_or_si128(le(v, 0x1F), _mm_or_si128(eq(v, '"'), eq(v, '\\'))));
+    }
+#endif
+    static const char* named(uint8_t c) {
+        switch (c) {
+            case '"': return "\\\"";
+            case '\\': return "\\\\";
+            case '\b': return "\\b";
+            case '\f': return "\\f";
+            case '\n': return "\\n";
+            case '\r': return "\\r";
+            case '\t': return "\\t";
+        }
+        return nullptr;
+    }
+    static size_t width(uint8_t c) { return named(c) ? 2 : 6; }
+    static size_t put(char* o, uint8_t c) {
+        if (const char* e = named(c)) {
+            o[0] = e[0];
+            o[1] = e[1];
+            return 2;
+        }
+        std::memcpy(o, "\\u00", 4);
+        o[4] = itoc(c >> 4);
+        o[5] = itoc(c & 0xF);
+        return 6;
+    }
+};
+
+struct cclass {
+    static bool test(uint8_t c) {
+        return c < 0x20 || c >= 0x7F || c == '"' || c == '\'' || c == '\\';
+    }
+#ifdef STRUTIL_SSE2
+    static int mask(__m128i v) {
+        __m128i m = _mm_or_si128(le(v, 0x1F), _mm_cmpeq_epi8(_mm_max_epu8(v, splat(0x7F)), v));
+        m = _mm_or_si128(m, _mm_or_si128(eq(v, '"'), _mm_or_si128(eq(v, '\''), eq(v, '\\'))));
+        return _mm_movemask_epi8(m);
+    }
+#endif
+    static char named(uint8_t c) {
+        switch (c) {
+            case '"': return '"';
+            case '\'': return '\'';
+            case '\\': return '\\';
+            case '\a': return 'a';
+            case '\b': return 'b';
+            case '\f': return 'f';
+            case '\n': return 'n';
+            case '\r': return 'r';
+            case '\t': return 't';
+            case '\v': return 'v';
+        }
+        return '\0';
+    }
+    // octal is used rather than \x since \x has no length limit in C.
+    static size_t width(uint8_t c) { return named(c) ? 2 : 4; }
+    static size_t put(char* o, uint8_t c) {
+        o[0] = '\\';
+        if (char e = named(c)) {
+            o[1] = e;
+            return 2;
+        }
+        o[1] = '0' + (c >> 6);
+        o[2] = '0' + ((c >> 3) & 7);
+        o[3] = '0' + (c & 7);
+        return 4;
+    }
+};
+
+// RFC 3986 unreserved characters pass through, everything else is %XX.
+struct urlclass {
+    static bool test(uint8_t c) {
+        return !(('0' <= c && c <= '9') || ('A' <= c && c <= 'Z') || ('a' <= c && c <= 'z') ||
+                 c == '-' || c == '.' || c == '_' || c == '~');
+    }
+#ifdef STRUTIL_SSE2
+    static int mask(__m128i v) {
+        __m128i ok = _mm_or_si128(inrange(v, '0', '9'), _mm_or_si128(inrange(v, 'A', 'Z'), inrange(v, 'a', 'z')));
+        ok = _mm_or_si128(ok, _mm_or_si128(_mm_or_si128(eq(v, '-'), eq(v, '.')), _mm_or_si128(eq(v, '_'), eq(v, '~'))));
+        return ~_mm_movemask_epi8(ok) & 0xFFFF;
+    }
+#endif
+    static size_t width(uint8_t) { return 3; }
+    static size_t put(char* o, uint8_t c) {
+        o[0] = '%';
+        o[1] = itoc(c >> 4, true);
+        o[2] = itoc(c & 0xF, true);
+        return 3;
+    }
+};
+
+inline int b64val(char c) {
+    return ('A' <= c && c <= 'Z') ? c - 'A' :
+           ('a' <= c && c <= 'z') ? c - 'a' + 26 :
+           ('0' <= c && c <= '9') ? c - '0' + 52 :
+           c == '+' ? 62 : c == '/' ? 63 : -1;
+}
+
+}  // namespace _detail
+
+// json
+
+inline size_t jsonescapesize(const char* s, size_t n) {
+    return _detail::escapesize<_detail::jsonclass>(s, n);
+}
+
+inline size_t jsonescape(char* out, const char* s, size_t n) {
+    return _detail::escape<_detail::jsonclass>(out, s, n);
+}
+
+inline std::string jsonescape(const std::string& s) {
+    return _detail::sized<jsonescapesize, jsonescape>(s);
+}
+
+inline size_t jsonunescape(char* out, const char* s, size_t n) {
+    char* o = out;
+    size_t i = 0;
+    while (i < n) {
+        const char* bs = static_cast<const char*>(std::memchr(s + i, '\\', n - i));
+        size_t j = bs ? bs - s : n;
+        std::memmove(o, s + i, j - i);
+        o += j - i;
+        if (j == n) break;
+        if (j + 1 >= n)
+            throw decodeerror("jsonunescape: trailing backslash");
+        switch (s[j + 1]) {
+            case '"': *o++ = '"'; break;
+            case '\\': *o++ = '\\'; break;
+            case '/': *o++ = '/'; break;
+            case 'b': *o++ = '\b'; break;
+            case 'f': *o++ = '\f'; break;
+            case 'n': *o++ = '\n'; break;
+            case 'r': *o++ = '\r'; break;
+            case 't': *o++ = '\t'; break;
+            case 'u': {
+                int h, l;
+                if (j + 6 > n || (h = _detail::hexbyte(s + j + 2)) < 0 || (l = _detail::hexbyte(s + j + 4)) < 0)
+                    throw decodeerror("jsonunescape: invalid \\u escape");
+                uint32_t uc = h << 8 | l;
+                if (0xD800 <= uc && uc < 0xDC00) {
+                    if (j + 12 > n || s[j + 6] != '\\' || s[j + 7] != 'u' ||
+                        (h = _detail::hexbyte(s + j + 8)) < 0 || (l = _detail::hexbyte(s + j + 10)) < 0 ||
+                        (h << 8 | l) < 0xDC00 || (h << 8 | l) >= 0xE000)
+                        throw decodeerror("jsonunescape: unpaired surrogate");
+                    uc = 0x10000 + ((uc - 0xD800) << 10) + ((h << 8 | l) - 0xDC00);
+                    j += 6;
+                } else if (0xDC00 <= uc && uc < 0xE000) {
+                    throw decodeerror("jsonunescape: unpaired surrogate");
+                }
+                o += _detail::u8put(o, uc);
+                j += 4;
+                break;
+            }
+            default:
+                throw decodeerror("jsonunescape: unknown escape");
+        }
+        i = j + 2;
+    }
+    return o - out;
+}
+
+inline std::string jsonunescape(const std::string& s) {
+    return _detail::bounded<jsonunescape>(s);
+}
+
+// c
+
+inline size_t cescapesize(const char* s, size_t n) {
+    return _detail::escapesize<_detail::cclass>(s, n);
+}
+
+inline size_t cescape(char* out, const char* s, size_t n) {
+    return _detail::escape<_detail::cclass>(out, s, n);
+}
+
+inline std::string cescape(const std::string& s) {
+    return _detail::sized<cescapesize, cescape>(s);
+}
+
+inline size_t cunescape(char* out, const char* s, size_t n) {
+    char* o = out;
+    size_t i = 0;
+    while (i < n) {
+        const char* bs = static_cast<const char*>(std::memchr(s + i, '\\', n - i));
+        size_t j = bs ? bs - s : n;
+        std::memmove(o, s + i, j - i);
+        o += j - i;
+        if (j == n) break;
+        if (++j >= n)
+            throw decodeerror("cunescape: trailing backslash");
+        switch (s[j++]) {
+            case '"': *o++ = '"'; break;
+            case '\'': *o++ = '\''; break;
+            case '\\': *o++ = '\\'; break;
+            case '?': *o++ = '?'; break;
+            case 'a': *o++ = '\a'; break;
+            case 'b': *o++ = '\b'; break;
+            case 'f': *o++ = '\f'; break;
+            case 'n': *o++ = '\n'; break;
+            case 'r': *o++ = '\r'; break;
+            case 't': *o++ = '\t'; break;
+            case 'v': *o++ = '\v'; break;
+            case '0': case '1': case '2': case '3':
+            case '4': case '5': case '6': case '7': {
+                int c = s[j - 1] - '0';
+                for (int k = 0; k < 2 && j < n && '0' <= s[j] && s[j] <= '7'; ++k) {
+                    c = c * 8 + s[j++] - '0';
+                }
+                if (c > 0xFF)
+                    throw decodeerror("cunescape: octal escape out of range");
+                *o++ = static_cast<char>(c);
+                break;
+            }
+            case 'x': {
+                int c = 0, k = 0;
+                for (; k < 2 && j < n && _detail::hexval(s[j]) >= 0; ++k) {
+                    c = c * 16 + _detail::hexval(s[j++]);
+                }
+                if (k == 0)
+                    throw decodeerror("cunescape: invalid \\x escape");
+                *o++ = static_cast<char>(c);
+                break;
+            }
+            default:
+                throw decodeerror("cunescape: unknown escape");
+        }
+        i = j;
+    }
+    return o - out;
+}
+
+inline std::string cunescape(const std::string& s) {
+    return _detail::bounded<cunescape>(s);
+}
+
+// url (percent-encoding)
+
+inline size_t urlescapesize(const char* s, size_t n) {
+    return _detail::escapesize<_detail::urlclass>(s, n);
+}
+
+inline size_t urlescape(char* out, const char* s, size_t n) {
+    return _detail::escape<_detail::urlclass>(out, s, n);
+}
+
+inline std::string urlescape(const std::string& s) {
+    return _detail::sized<urlescapesize, urlescape>(s);
+}
+
+inline size_t urlunescape(char* out, const char* s, size_t n) {
+    char* o = out;
+    size_t i = 0;
+    while (i < n) {
+        const char* pc = static_cast<const char*>(std::memchr(s + i, '%', n - i));
+        size_t j = pc ? pc - s : n;
+        std::memmove(o, s + i, j - i);
+        o += j - i;
+        if (j == n) break;
+        int c;
+        if (j + 3 > n || (c = _detail::hexbyte(s + j + 1)) < 0)
+            throw decodeerror("urlunescape: invalid percent-encoding");
+        *o++ = static_cast<char>(c);
+        i = j + 3;
+    }
+    return o - out;
+}
+
+inline std::string urlunescape(const std::string& s) {
+    return _detail::bounded<urlunescape>(s);
+}
+
+// hex
+
+inline size_t hexencodesize(const char*, size_t n) {
+    return n * 2;
+}
+
+inline size_t hexencode(char* out, const char* s, size_t n) {
+    size_t i = 0;
+#ifdef STRUTIL_SSE2
+    const __m128i nibble = _detail::splat(0x0F);
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+        __m128i lo = _mm_and_si128(v, nibble);
+        __m128i a = _mm_unpacklo_epi8(hi, lo);
+        __m128i b = _mm_unpackhi_epi8(hi, lo);
+        // '0' + x, plus ('a' - '0' - 10) where x > 9.
+        a = _mm_add_epi8(_mm_add_epi8(a, _detail::splat('0')),
+                         _mm_and_si128(_mm_cmpgt_epi8(a, _detail::splat(9)), _detail::splat('a' - '0' - 10)));
+        b = _mm_add_epi8(_mm_add_epi8(b, _detail::splat('0')),
+                         _mm_and_si128(_mm_cmpgt_epi8(b, _detail::splat(9)), _detail::splat('a' - '0' - 10)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), a);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2 + 16), b);
+    }
+#endif
+    for (; i < n; ++i) {
+        uint8_t c = static_cast<uint8_t>(s[i]);
+        out[i * 2] = _detail::itoc(c >> 4);
+        out[i * 2 + 1] = _detail::itoc(c & 0xF);
+    }
+    return n * 2;
+}
+
+inline std::string hexencode(const std::string& s) {
+    return _detail::sized<hexencodesize, hexencode>(s);
+}
+
+inline size_t hexdecodesize(const char*, size_t n) {
+    if (n % 2 != 0)
+        throw decodeerror("hexdecode: odd length");
+    return n / 2;
+}
+
+inline size_t hexdecode(char* out, const char* s, size_t n) {
+    size_t size = hexdecodesize(s, n);
+    for (size_t i = 0; i < size; ++i) {
+        int c = _detail::hexbyte(s + i * 2);
+        if (c < 0)
+            throw decodeerror("hexdecode: invalid digit");
+        out[i] = static_cast<char>(c);
+    }
+    return size;
+}
+
+inline std::string hexdecode(const std::string& s) {
+    return _detail::sized<hexdecodesize, hexdecode>(s);
+}
+
+// base64 (RFC 4648, standard alphabet; decoding accepts missing padding)
+
+inline size_t b64encodesize(const char*, size_t n) {
+    return (n + 2) / 3 * 4;
+}
+
+inline size_t b64encode(char* out, const char* s, size_t n) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const uint8_t* u = reinterpret_cast<const uint8_t*>(s);
+    char* o = out;
+    size_t i = 0;
+    for (; i + 3 <= n; i += 3) {
+        uint32_t v = u[i] << 16 | u[i + 1] << 8 | u[i + 2];
+        o[0] = table[v >> 18];
+        o[1] = table[(v >> 12) & 0x3F];
+        o[2] = table[(v >> 6) & 0x3F];
+        o[3] = table[v & 0x3F];
+        o += 4;
+    }
+    if (i < n) {
+        uint32_t v = u[i] << 16 | (i + 1 < n ? u[i + 1] << 8 : 0);
+        o[0] = table[v >> 18];
+        o[1] = table[(v >> 12) & 0x3F];
+        o[2] = i + 1 < n ? table[(v >> 6) & 0x3F] : '=';
+        o[3] = '=';
+        o += 4;
+    }
+    return o - out;
+}
+
+inline std::string b64encode(const std::string& s) {
+    return _detail::sized<b64encodesize, b64encode>(s);
+}
+
+inline size_t b64decodesize(const char* s, size_t n) {
+    size_t pad = 0;
+    while (pad < n && s[n - 1 - pad] == '=') pad++;
+    if (pad > 2 || (pad > 0 && n % 4 != 0))
+        throw decodeerror("b64decode: invalid padding");
+    n -= pad;
+    if (n % 4 == 1)
+        throw decodeerror("b64decode: invalid length");
+    return n / 4 * 3 + (n % 4 == 0 ? 0 : n % 4 - 1);
+}
+
+inline size_t b64decode(char* out, const char* s, size_t n) {
+    size_t size = b64decodesize(s, n);
+    size_t i = 0, o = 0;
+    for (; o + 3 <= size; i += 4, o += 3) {
+        int a = _detail::b64val(s[i]), b = _detail::b64val(s[i + 1]);
+        int c = _detail::b64val(s[i + 2]), d = _detail::b64val(s[i + 3]);
+        if ((a | b | c | d) < 0)
+            throw decodeerror("b64decode: invalid character");
+        uint32_t v = a << 18 | b << 12 | c << 6 | d;
+        out[o] = static_cast<char>(v >> 16);
+        out[o + 1] = static_cast<char>(v >> 8);
+        out[o + 2] = static_cast<char>(v);
+    }
+    if (o < size) {
+        int a = _detail::b64val(s[i]), b = _detail::b64val(s[i + 1]);
+        int c = o + 1 < size ? _detail::b64val(s[i + 2]) : 0;
+        if ((a | b | c) < 0)
+            throw decodeerror("b64decode: invalid character");
+        // canonical encodings leave the unused low bits of the last quantum zero.
+        if (o + 1 < size ? (c & 0x03) : (b & 0x0F))
+            throw decodeerror("b64decode: non-zero trailing bits");
+        uint32_t v = a << 18 | b << 12 | c << 6;
+        out[o++] = static_cast<char>(v >> 16);
+        if (o < size) out[o++] = static_cast<char>(v >> 8);
+    }
+    return size;
+}
+
+inline std::string b64decode(const std::string& s) {
+    return _detail::sized<b64decodesize, b64decode>(s);
+}
+
+
 }
@@ -24,6 +24,11 @@ constexpr auto sc = ctstr::make("0.1.2.3");
 constexpr auto b1 = sc.compare("0.1.3.3");
 constexpr auto b2 = sc.compare("0.1.1.3");
 constexpr auto b3 = b1 + b2;
+constexpr auto n1 = sc.natural_compare("0.1.10.3");
+constexpr auto n2 = ctstr::make("file10").natural_compare("FILE9", true);
+constexpr auto i1 = ctstr::make("Hello").icompare("hELLO");
+constexpr auto k1 = ctstr::make("Hello, World").iprefixkey();
+static_assert(n1 == -1 && n2 == 1 && i1 == 0, "ctstr comparisons");
 
 
 int main()
@@ -61,6 +66,10 @@ int main()
     p << format("s=[%7s]", "hello");
     p << format("s=[%7s]", std::string("hello"));
     printf("s=[%7s]\n", "hello");
+    p << format("s=[%-120s]", "wide");
+    p << format("s=[%7Ls]", "日本");
+    p << format("s=[%-7ls]", "日本");
+    try { format("%4294967297s", "x"); } catch (const formaterror& e) { p << e.what(); }
 
     // hex
     p << format("x=[%04x]", 255);
@@ -82,5 +91,41 @@ int main()
     p << format("f=[%.12f]", 50.12345678);
     printf("f=[%.12f]\n", 50.12345678);
 
+    // width
+    p << strwidth("日本語テキスト abc", widthmode::columns);
+    p << strwidth("日本語テキスト abc", widthmode::codepoints);
+    p << strwidth("ka\xe3\x82\x99", widthmode::columns);
+    p << padright("名前", 8, '.', widthmode::columns) + "|";
+    p << padleft("名前", 8, '.', widthmode::codepoints) + "|";
+    p << center("表", 7, '*', widthmode::columns) + "|";
+    p << truncate("日本語テキスト", 9, widthmode::columns, "…") + "|";
+    p << truncate("日本語テキスト", 4, widthmode::codepoints) + "|";
+    p << truncate("hello, world", 8, widthmode::bytes, "...") + "|";
+
+    // compare
+    p << icompare("Hello", "hELLO");
+    p << icompare("abc_", "ABCD");
+    p << icompare(std::string("The quick brown fox jumps"), std::string("THE QUICK BROWN FOX JUMPED"));
+    p << natural_compare("0.1.2.3", "0.1.10.3");
+    p << natural_compare("file010b", "file10a");
+    p << natural_compare("img12", "IMG9", true);
+    p << (iprefixkey("Hello, World") == k1);
+    p << (prefixkey("0.1.2") < prefixkey("0.1.3"));
+    p << n1 << n2 << i1;
+
+    // codecs
+    p << jsonescape("say \"hi\"\tto\x01 \\ the long clean run of ascii text");
+    p << jsonunescape("say \\\"hi\\\"\\t\\u3042\\ud83d\\ude00");
+    p << cescape("it's a\n\"pen\"\x7f\xe3\x81\x82");
+    p << cunescape("it\\'s a\\n\\\"pen\\\"\\177\\x41");
+    p << urlescape("a b&c=d/e~f.g_h-i\xe3\x81\x82");
+    p << urlunescape("a%20b%26c%3Dd%2fe~f");
+    p << hexencode("hello, world. \x01\xff hexdump");
+    p << hexdecode("68656c6c6f2C20776f726c64");
+    for (const auto s: {"", "f", "fo", "foo", "foob", "fooba", "foobar"}) {
+        p << b64encode(s) + " " + b64decode(b64encode(s)) + "|";
+    }
+    p << b64decode("Zm9vYg");
+
     return 0;
 }